@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// Compact binary representation of a single frame of tracking data. It is
+// shared by the non-WebSocket outputs and by the header-only readers, so it
+// must not depend on anything but the standard library. All values are
+// stored in host byte order; the multicast output converts them to
+// little-endian on the wire, see multicast.hpp.
+
+constexpr std::uint32_t kBinaryFrameMaxBodies = 64;
+
+struct BinaryBody {
+  std::uint32_t id;
+  std::uint32_t is_tracked;
+  // Position in millimeters as reported by DTrack.
+  float position[3];
+  // Orientation as a unit quaternion (x, y, z, w).
+  float orientation[4];
+};
+
+struct BinaryFrameHeader {
+  std::uint64_t frame;
+  double time;
+  double delta_time;
+  std::uint64_t tracking_frame;
+  double tracking_time;
+  std::uint32_t num_bodies;
+  std::uint32_t reserved;
+};
+
+struct BinaryFrame {
+  BinaryFrameHeader header;
+  BinaryBody bodies[kBinaryFrameMaxBodies];
+};
+
+static_assert(sizeof(BinaryBody) == 36);
+static_assert(sizeof(BinaryFrameHeader) == 48);
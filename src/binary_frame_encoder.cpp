@@ -0,0 +1,92 @@
+#include "binary_frame_encoder.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// Converts DTrack's column-wise 3x3 rotation matrix to a quaternion (x, y, z, w).
+void RotationMatrixToQuaternion(const std::array<double, 9>& rotation, float* quaternion) {
+  const auto m = [&rotation](int row, int column) { return rotation[column * 3 + row]; };
+
+  double x, y, z, w;
+  const double trace = m(0, 0) + m(1, 1) + m(2, 2);
+  if (trace > 0.0) {
+    const double s = std::sqrt(trace + 1.0) * 2.0;
+    w = 0.25 * s;
+    x = (m(2, 1) - m(1, 2)) / s;
+    y = (m(0, 2) - m(2, 0)) / s;
+    z = (m(1, 0) - m(0, 1)) / s;
+  } else if (m(0, 0) > m(1, 1) && m(0, 0) > m(2, 2)) {
+    const double s = std::sqrt(1.0 + m(0, 0) - m(1, 1) - m(2, 2)) * 2.0;
+    w = (m(2, 1) - m(1, 2)) / s;
+    x = 0.25 * s;
+    y = (m(0, 1) + m(1, 0)) / s;
+    z = (m(0, 2) + m(2, 0)) / s;
+  } else if (m(1, 1) > m(2, 2)) {
+    const double s = std::sqrt(1.0 + m(1, 1) - m(0, 0) - m(2, 2)) * 2.0;
+    w = (m(0, 2) - m(2, 0)) / s;
+    x = (m(0, 1) + m(1, 0)) / s;
+    y = 0.25 * s;
+    z = (m(1, 2) + m(2, 1)) / s;
+  } else {
+    const double s = std::sqrt(1.0 + m(2, 2) - m(0, 0) - m(1, 1)) * 2.0;
+    w = (m(1, 0) - m(0, 1)) / s;
+    x = (m(0, 2) + m(2, 0)) / s;
+    y = (m(1, 2) + m(2, 1)) / s;
+    z = 0.25 * s;
+  }
+
+  quaternion[0] = static_cast<float>(x);
+  quaternion[1] = static_cast<float>(y);
+  quaternion[2] = static_cast<float>(z);
+  quaternion[3] = static_cast<float>(w);
+}
+
+}
+
+void EncodeBinaryFrame(std::uint64_t frame, double time, double delta_time,
+                       const nlohmann::json& tracking_data, BinaryFrame* binary_frame) {
+  BinaryFrameHeader& header = binary_frame->header;
+  header.frame = frame;
+  header.time = time;
+  header.delta_time = delta_time;
+  header.tracking_frame = 0;
+  header.tracking_time = 0.0;
+  header.num_bodies = 0;
+  header.reserved = 0;
+
+  // The tracking data is null until the first frame has been received.
+  if (!tracking_data.is_object()) {
+    return;
+  }
+
+  header.tracking_frame = tracking_data.value("frame", std::uint64_t{0});
+  header.tracking_time = tracking_data.value("time", 0.0);
+
+  const auto bodies = tracking_data.find("bodies");
+  if (bodies == tracking_data.end() || !bodies->is_array()) {
+    return;
+  }
+
+  for (const auto& body : *bodies) {
+    if (header.num_bodies == kBinaryFrameMaxBodies) {
+      break;
+    }
+
+    BinaryBody& binary_body = binary_frame->bodies[header.num_bodies++];
+    binary_body.id = body.value("id", std::uint32_t{0});
+    binary_body.is_tracked = body.value("isTracked", false);
+    std::fill(std::begin(binary_body.position), std::end(binary_body.position), 0.0f);
+    std::fill(std::begin(binary_body.orientation), std::end(binary_body.orientation), 0.0f);
+    binary_body.orientation[3] = 1.0f;
+
+    if (binary_body.is_tracked) {
+      const auto position = body.at("position").get<std::array<double, 3>>();
+      std::copy(position.begin(), position.end(), binary_body.position);
+      RotationMatrixToQuaternion(body.at("orientation").get<std::array<double, 9>>(),
+                                 binary_body.orientation);
+    }
+  }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+#include "binary_frame.hpp"
+#include "nlohmann/json.hpp"
+
+// Fills `binary_frame` from the JSON tracking data produced by DTrack. Bodies
+// beyond kBinaryFrameMaxBodies are dropped.
+void EncodeBinaryFrame(std::uint64_t frame, double time, double delta_time,
+                       const nlohmann::json& tracking_data, BinaryFrame* binary_frame);
@@ -1,7 +1,8 @@
 #include "dtrack.hpp"
+#include "realtime.hpp"
 #include "spdlog/spdlog.h"
 
-DTrack::DTrack(const std::string& connection)
+DTrack::DTrack(const std::string& connection, const ThreadConfig& receive_thread_config)
   : m_dtrack_sdk(connection) {
   if (connection.empty()) {
     spdlog::warn("No dtrack connection specified. Use --dtrack=ip:port to establish a dtrack connection");
@@ -40,6 +41,10 @@ DTrack::DTrack(const std::string& connection)
   } else {
     LogError();
   }
+
+  if (m_dtrack_sdk.isDataInterfaceValid()) {
+    m_receive_thread = std::thread(&DTrack::ReceiveThread, this, receive_thread_config);
+  }
 }
 
 DTrack::~DTrack() {
@@ -55,11 +60,14 @@ DTrack::~DTrack() {
   }
 }
 
-void DTrack::ReceiveThread() {
+void DTrack::ReceiveThread(ThreadConfig config) {
+  ConfigureCurrentThread("receive", config);
+  PrefaultStack();
+
   while (!m_quit.load(std::memory_order_relaxed)) {
     if (m_dtrack_sdk.receive()) {
       auto new_data = GenerateJSON();
-      std::unique_lock<std::mutex> lock(m_data_mutex);
+      std::unique_lock<PriorityInheritanceMutex> lock(m_data_mutex);
       std::swap(m_tracking_data, new_data);
     } else {
       LogError();
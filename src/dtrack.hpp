@@ -5,15 +5,17 @@
 #include <thread>
 
 #include "DTrackSDK.hpp"
+#include "options.hpp"
+#include "realtime.hpp"
 #include "nlohmann/json.hpp"
 
 class DTrack {
 public:
-  DTrack(const std::string &connection);
+  DTrack(const std::string &connection, const ThreadConfig& receive_thread_config);
   ~DTrack();
 
   nlohmann::json tracking_data() const {
-    std::unique_lock<std::mutex> lock(m_data_mutex);
+    std::unique_lock<PriorityInheritanceMutex> lock(m_data_mutex);
     nlohmann::json tracking_data = m_tracking_data;
     return tracking_data;
   }
@@ -23,9 +25,10 @@ private:
 
   std::atomic<bool> m_quit = false;
   std::thread m_receive_thread;
-  void ReceiveThread();
+  void ReceiveThread(ThreadConfig config);
 
-  mutable std::mutex m_data_mutex;
+  // Shared by the receive and update threads, which may both run SCHED_FIFO.
+  mutable PriorityInheritanceMutex m_data_mutex;
   nlohmann::json m_tracking_data;
 
   nlohmann::json GenerateJSON();
@@ -5,9 +5,42 @@
 #include "argh.h"
 
 #include "options.hpp"
+#include "realtime.hpp"
 #include "webcave_server.hpp"
 
 const std::string_view help_string = R"(webcave-server
+
+Tracking:
+  -d, --dtrack <ip:port>       DTrack connection
+  -r, --update-rate <hz>       Frames per second (default 60)
+  -p, --port <port>            WebSocket port (default 5000)
+  -u, --upstream <uri>         Relay the frames of another webcave-server
+                               (e.g. ws://host:5000) instead of using DTrack
+
+Outputs:
+  --shm <name>                 Publish frames to a POSIX shared-memory object
+  --shm-slots <n>              Ring size of the shared-memory output (default 8)
+  --multicast <group>          Send frames to a UDP multicast group
+  --multicast-port <port>      (default 5001)
+  --multicast-ttl <ttl>        (default 1)
+  --multicast-interface <ip>   Outgoing interface for multicast
+  --ice-server <uri>           STUN/TURN server for WebRTC clients
+
+Real-time (Linux):
+  --receive-cpus <list>        CPUs for the DTrack receive thread, e.g. 2,3 or 4-7
+  --receive-priority <1-99>    SCHED_FIFO priority of the receive thread
+  --update-cpus <list>         CPUs for the update thread
+  --update-priority <1-99>     SCHED_FIFO priority of the update thread
+  --io-cpus <list>             CPUs for the network thread
+  --io-priority <1-99>         SCHED_FIFO priority of the network thread
+  --lock-memory                Lock all memory to avoid page faults
+  --latency-test               Measure thread wakeup latency and exit
+  --latency-test-duration <s>  (default 10)
+
+  Priorities need CAP_SYS_NICE or an rtprio limit (ulimit -r) of at least
+  the requested priority. --lock-memory needs CAP_IPC_LOCK or an unlimited
+  memlock limit (ulimit -l unlimited, LimitMEMLOCK=infinity for systemd),
+  with a finite limit the server refuses to start.
 )";
 
 std::optional<WebCaveServer> server;
@@ -23,13 +56,63 @@ int main(int argc, char* argv[]) {
     "-r", "--update-rate",
     "-d", "--dtrack",
     "-p", "--port",
+    "-u", "--upstream",
+    "--shm",
+    "--shm-slots",
+    "--multicast",
+    "--multicast-port",
+    "--multicast-ttl",
+    "--multicast-interface",
+    "--ice-server",
+    "--receive-cpus",
+    "--receive-priority",
+    "--update-cpus",
+    "--update-priority",
+    "--io-cpus",
+    "--io-priority",
+    "--latency-test-duration",
   });
   cmdl.parse(argc, argv);
 
+  if (cmdl[{"-h", "--help"}]) {
+    std::cout << help_string;
+    return EXIT_SUCCESS;
+  }
+
   Options options;
   cmdl("update-rate") >> options.update_rate;
   cmdl("port") >> options.port;
   cmdl("dtrack") >> options.dtrack_connection;
+  cmdl("upstream") >> options.upstream;
+  cmdl("shm") >> options.shared_memory_name;
+  cmdl("shm-slots", options.shared_memory_slots) >> options.shared_memory_slots;
+  cmdl("multicast") >> options.multicast_group;
+  cmdl("multicast-port", options.multicast_port) >> options.multicast_port;
+  cmdl("multicast-ttl", options.multicast_ttl) >> options.multicast_ttl;
+  cmdl("multicast-interface") >> options.multicast_interface;
+  cmdl("ice-server") >> options.ice_server;
+
+  const auto parse_thread_config = [&cmdl](const std::string& role, ThreadConfig* config) {
+    std::string cpus;
+    cmdl(role + "-cpus") >> cpus;
+    config->cpus = ParseCpuList(cpus);
+    cmdl(role + "-priority", config->priority) >> config->priority;
+  };
+  parse_thread_config("receive", &options.receive_thread);
+  parse_thread_config("update", &options.update_thread);
+  parse_thread_config("io", &options.io_thread);
+  options.lock_memory = cmdl["lock-memory"];
+  options.latency_test = cmdl["latency-test"];
+  cmdl("latency-test-duration", options.latency_test_duration) >> options.latency_test_duration;
+
+  if (options.lock_memory && !LockMemory()) {
+    return EXIT_FAILURE;
+  }
+
+  if (options.latency_test) {
+    return RunWakeupLatencyTest(options, std::chrono::seconds(options.latency_test_duration))
+        ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
 
   struct sigaction sigint_handler;
   sigint_handler.sa_handler = handle_signint;
@@ -0,0 +1,231 @@
+#pragma once
+
+// Packet layout of the UDP multicast output and a header-only receiver for
+// it. Cluster nodes can include this file together with binary_frame.hpp to
+// receive frames without a WebSocket connection per node.
+//
+// Every datagram carries exactly one frame: a MulticastPacketHeader followed
+// by the BinaryFrameHeader and `num_bodies` BinaryBody entries. To avoid IP
+// fragmentation, where losing one fragment loses the whole frame, a datagram
+// carries at most kMulticastMaxBodies bodies so it fits into a 1500 byte
+// Ethernet MTU. Further bodies are not sent. The sequence
+// number is incremented for every datagram so receivers can detect gaps. The
+// epoch is chosen randomly whenever a sender starts, so receivers can tell a
+// restarted sender from reordered datagrams. Late datagrams of the previous
+// epoch are dropped. Use one sender per group.
+//
+// All fields are little-endian on the wire, IEEE 754 floats included, so
+// senders and receivers of different architectures can be mixed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "binary_frame.hpp"
+
+constexpr std::uint32_t kMulticastMagic = 0x4d434357; // "WCCM"
+constexpr std::uint16_t kMulticastVersion = 2;
+
+struct MulticastPacketHeader {
+  std::uint32_t magic;
+  std::uint16_t version;
+  std::uint16_t reserved;
+  // Never 0, receivers use 0 for "no epoch seen yet".
+  std::uint64_t epoch;
+  std::uint64_t sequence;
+};
+
+struct MulticastPacket {
+  MulticastPacketHeader header;
+  BinaryFrame frame;
+};
+
+static_assert(sizeof(MulticastPacketHeader) == 24);
+static_assert(offsetof(MulticastPacket, frame) == sizeof(MulticastPacketHeader));
+
+constexpr std::size_t MulticastPacketSize(std::uint32_t num_bodies) {
+  return sizeof(MulticastPacketHeader) + sizeof(BinaryFrameHeader) +
+         num_bodies * sizeof(BinaryBody);
+}
+
+// Ethernet MTU minus IPv4 and UDP headers.
+constexpr std::size_t kMulticastMaxPayloadSize = 1500 - 20 - 8;
+constexpr std::uint32_t kMulticastMaxBodies = static_cast<std::uint32_t>(
+    (kMulticastMaxPayloadSize - MulticastPacketSize(0)) / sizeof(BinaryBody));
+
+static_assert(MulticastPacketSize(kMulticastMaxBodies) <= kMulticastMaxPayloadSize);
+static_assert(kMulticastMaxBodies <= kBinaryFrameMaxBodies);
+
+// Converts between host and wire byte order. Swapping is its own inverse,
+// so the same functions are used for sending and receiving.
+template <typename T>
+inline void MulticastConvertByteOrder(T* value) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  unsigned char bytes[sizeof(T)];
+  std::memcpy(bytes, value, sizeof(T));
+  std::reverse(bytes, bytes + sizeof(T));
+  std::memcpy(value, bytes, sizeof(T));
+#else
+  (void)value;
+#endif
+}
+
+// Converts the packet header and the frame header, but not the bodies: the
+// receiver has to validate num_bodies before it can touch them.
+inline void MulticastConvertHeaderByteOrder(MulticastPacket* packet) {
+  MulticastConvertByteOrder(&packet->header.magic);
+  MulticastConvertByteOrder(&packet->header.version);
+  MulticastConvertByteOrder(&packet->header.reserved);
+  MulticastConvertByteOrder(&packet->header.epoch);
+  MulticastConvertByteOrder(&packet->header.sequence);
+
+  BinaryFrameHeader& frame_header = packet->frame.header;
+  MulticastConvertByteOrder(&frame_header.frame);
+  MulticastConvertByteOrder(&frame_header.time);
+  MulticastConvertByteOrder(&frame_header.delta_time);
+  MulticastConvertByteOrder(&frame_header.tracking_frame);
+  MulticastConvertByteOrder(&frame_header.tracking_time);
+  MulticastConvertByteOrder(&frame_header.num_bodies);
+  MulticastConvertByteOrder(&frame_header.reserved);
+}
+
+inline void MulticastConvertBodyByteOrder(BinaryBody* body) {
+  MulticastConvertByteOrder(&body->id);
+  MulticastConvertByteOrder(&body->is_tracked);
+  for (float& value : body->position) {
+    MulticastConvertByteOrder(&value);
+  }
+  for (float& value : body->orientation) {
+    MulticastConvertByteOrder(&value);
+  }
+}
+
+class MulticastReceiver {
+ public:
+  MulticastReceiver() = default;
+  MulticastReceiver(const std::string& group, std::uint16_t port,
+                    const std::string& interface_address = "0.0.0.0") {
+    Open(group, port, interface_address);
+  }
+  ~MulticastReceiver() { Close(); }
+
+  MulticastReceiver(const MulticastReceiver&) = delete;
+  MulticastReceiver& operator=(const MulticastReceiver&) = delete;
+
+  bool Open(const std::string& group, std::uint16_t port,
+            const std::string& interface_address = "0.0.0.0") {
+    Close();
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+      return false;
+    }
+
+    const int reuse = 1;
+    setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    ip_mreq membership{};
+    if (inet_pton(AF_INET, group.c_str(), &membership.imr_multiaddr) != 1 ||
+        inet_pton(AF_INET, interface_address.c_str(), &membership.imr_interface) != 1 ||
+        bind(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        setsockopt(m_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+      Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Close() {
+    if (m_socket >= 0) {
+      close(m_socket);
+      m_socket = -1;
+    }
+    m_epoch = 0;
+    m_previous_epoch = 0;
+  }
+
+  bool IsOpen() const { return m_socket >= 0; }
+
+  // Waits for the next frame. Stale and duplicate datagrams are skipped.
+  // Returns false on timeout or error.
+  bool Receive(BinaryFrame* frame, std::chrono::milliseconds timeout) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + timeout;
+
+    while (true) {
+      const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - Clock::now());
+      pollfd poll_fd{m_socket, POLLIN, 0};
+      if (remaining.count() < 0 || poll(&poll_fd, 1, remaining.count()) <= 0) {
+        return false;
+      }
+
+      const ssize_t size = recv(m_socket, &m_packet, sizeof(m_packet), 0);
+      if (size < static_cast<ssize_t>(MulticastPacketSize(0))) {
+        continue;
+      }
+      MulticastConvertHeaderByteOrder(&m_packet);
+      if (m_packet.header.magic != kMulticastMagic ||
+          m_packet.header.version != kMulticastVersion ||
+          m_packet.frame.header.num_bodies > kMulticastMaxBodies ||
+          static_cast<std::size_t>(size) != MulticastPacketSize(m_packet.frame.header.num_bodies)) {
+        continue;
+      }
+
+      const std::uint64_t epoch = m_packet.header.epoch;
+      const std::uint64_t sequence = m_packet.header.sequence;
+      if (epoch == 0 || epoch == m_previous_epoch) {
+        // A datagram of the previous run that arrived after the restart.
+        continue;
+      }
+      if (epoch == m_epoch) {
+        if (sequence < m_next_sequence) {
+          // Reordered or duplicated datagram, a newer frame was already delivered.
+          continue;
+        }
+        m_lost_packets += sequence - m_next_sequence;
+      } else {
+        // The sender has been restarted, start tracking its sequence from
+        // scratch.
+        m_previous_epoch = m_epoch;
+        m_epoch = epoch;
+      }
+      m_next_sequence = sequence + 1;
+      ++m_received_packets;
+
+      std::memcpy(frame, &m_packet.frame, size - sizeof(MulticastPacketHeader));
+      for (std::uint32_t i = 0; i < frame->header.num_bodies; ++i) {
+        MulticastConvertBodyByteOrder(&frame->bodies[i]);
+      }
+      return true;
+    }
+  }
+
+  std::uint64_t ReceivedPackets() const { return m_received_packets; }
+  std::uint64_t LostPackets() const { return m_lost_packets; }
+
+ private:
+  int m_socket = -1;
+  MulticastPacket m_packet;
+
+  std::uint64_t m_epoch = 0;
+  std::uint64_t m_previous_epoch = 0;
+  std::uint64_t m_next_sequence = 0;
+  std::uint64_t m_received_packets = 0;
+  std::uint64_t m_lost_packets = 0;
+};
@@ -0,0 +1,89 @@
+#include "multicast_output.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#include "spdlog/spdlog.h"
+
+MulticastOutput::MulticastOutput(const std::string& group, std::uint16_t port, int ttl,
+                                 const std::string& interface_address)
+  : m_socket(m_io_context) {
+  // Mix in the start time in case random_device is deterministic.
+  std::random_device random_device;
+  do {
+    m_epoch = (std::uint64_t{random_device()} << 32 | random_device()) ^
+              static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+  } while (m_epoch == 0);
+
+  asio::error_code error;
+  const auto group_address = asio::ip::make_address_v4(group, error);
+  if (error || !group_address.is_multicast()) {
+    spdlog::error("[Multicast] Invalid multicast group: {}", group);
+    return;
+  }
+  m_endpoint = asio::ip::udp::endpoint(group_address, port);
+
+  m_socket.open(asio::ip::udp::v4(), error);
+  if (error) {
+    spdlog::error("[Multicast] Failed to open socket: {}", error.message());
+    return;
+  }
+
+  m_socket.set_option(asio::ip::multicast::hops(ttl), error);
+  if (!error) {
+    m_socket.set_option(asio::ip::multicast::enable_loopback(true), error);
+  }
+  if (!error && !interface_address.empty()) {
+    const auto outbound_interface = asio::ip::make_address_v4(interface_address, error);
+    if (!error) {
+      m_socket.set_option(asio::ip::multicast::outbound_interface(outbound_interface), error);
+    }
+  }
+  if (error) {
+    spdlog::error("[Multicast] Failed to configure socket: {}", error.message());
+    m_socket.close();
+    return;
+  }
+
+  spdlog::info("[Multicast] Publishing frames to {}:{} (ttl {})", group, port, ttl);
+}
+
+void MulticastOutput::Publish(const BinaryFrame& frame) {
+  if (!m_socket.is_open()) {
+    return;
+  }
+
+  const std::uint32_t num_bodies = std::min(frame.header.num_bodies, kMulticastMaxBodies);
+  if (num_bodies < frame.header.num_bodies && !m_logged_dropped_bodies) {
+    spdlog::warn("[Multicast] Frame has {} bodies, only the first {} fit into a datagram",
+                 frame.header.num_bodies, kMulticastMaxBodies);
+    m_logged_dropped_bodies = true;
+  }
+
+  // The sequence number advances even if sending fails so receivers see the
+  // frame as lost instead of silently skipping it.
+  std::memset(&m_packet.header, 0, sizeof(m_packet.header));
+  m_packet.header.magic = kMulticastMagic;
+  m_packet.header.version = kMulticastVersion;
+  m_packet.header.epoch = m_epoch;
+  m_packet.header.sequence = m_sequence++;
+
+  std::memcpy(&m_packet.frame.header, &frame.header, sizeof(BinaryFrameHeader));
+  m_packet.frame.header.num_bodies = num_bodies;
+  std::memcpy(m_packet.frame.bodies, frame.bodies, num_bodies * sizeof(BinaryBody));
+
+  MulticastConvertHeaderByteOrder(&m_packet);
+  for (std::uint32_t i = 0; i < num_bodies; ++i) {
+    MulticastConvertBodyByteOrder(&m_packet.frame.bodies[i]);
+  }
+
+  asio::error_code error;
+  m_socket.send_to(asio::buffer(&m_packet, MulticastPacketSize(num_bodies)),
+                   m_endpoint, 0, error);
+
+  if (error) {
+    spdlog::error("[Multicast] {}", error.message());
+  }
+}
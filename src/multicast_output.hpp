@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "asio.hpp"
+#include "binary_frame.hpp"
+#include "multicast.hpp"
+
+// Sends every frame once as a UDP multicast datagram that can be received
+// with the MulticastReceiver from multicast.hpp.
+class MulticastOutput {
+ public:
+  MulticastOutput(const std::string& group, std::uint16_t port, int ttl,
+                  const std::string& interface_address);
+
+  bool IsValid() const { return m_socket.is_open(); }
+
+  // Chosen randomly on construction, see multicast.hpp.
+  std::uint64_t Epoch() const { return m_epoch; }
+
+  void Publish(const BinaryFrame& frame);
+
+ private:
+  asio::io_context m_io_context;
+  asio::ip::udp::socket m_socket;
+  asio::ip::udp::endpoint m_endpoint;
+
+  std::uint64_t m_epoch = 0;
+  std::uint64_t m_sequence = 0;
+  MulticastPacket m_packet;
+  bool m_logged_dropped_bodies = false;
+};
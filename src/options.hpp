@@ -2,9 +2,44 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
+
+struct ThreadConfig {
+  // CPUs the thread is pinned to. Empty leaves the affinity unchanged.
+  std::vector<int> cpus;
+  // SCHED_FIFO priority. 0 keeps the default scheduler.
+  int priority = 0;
+};
 
 struct Options {
   uint16_t port = 5000;
   double update_rate = 60;
   std::string dtrack_connection;
+
+  // URI of an upstream webcave-server (e.g. ws://host:5000). If set, the
+  // server runs as a relay and re-broadcasts the upstream frames instead of
+  // connecting to DTrack.
+  std::string upstream;
+
+  // Name of the POSIX shared-memory object frames are published to. Empty
+  // disables the shared-memory output.
+  std::string shared_memory_name;
+  uint32_t shared_memory_slots = 8;
+
+  // Multicast group frames are sent to. Empty disables the multicast output.
+  std::string multicast_group;
+  uint16_t multicast_port = 5001;
+  int multicast_ttl = 1;
+  std::string multicast_interface;
+
+  // STUN/TURN server used for WebRTC connections, e.g. stun:host:3478. Not
+  // required if clients are on the same network.
+  std::string ice_server;
+
+  ThreadConfig receive_thread;
+  ThreadConfig update_thread;
+  ThreadConfig io_thread;
+  bool lock_memory = false;
+  bool latency_test = false;
+  int latency_test_duration = 10;
 };
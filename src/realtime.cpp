@@ -0,0 +1,259 @@
+#include "realtime.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+#include <linux/capability.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "spdlog/spdlog.h"
+
+namespace {
+
+constexpr std::size_t kPrefaultStackSize = 256 * 1024;
+
+// A wakeup may be at most this fraction of a frame late, the rest of the
+// frame is needed to actually produce and send it.
+constexpr double kLatencyBudgetFraction = 0.1;
+
+std::string FormatCpuList(const std::vector<int>& cpus) {
+  std::string cpu_list;
+  for (const int cpu : cpus) {
+    if (!cpu_list.empty()) {
+      cpu_list += ',';
+    }
+    cpu_list += std::to_string(cpu);
+  }
+  return cpu_list;
+}
+
+bool HasEffectiveCapability(int capability) {
+  std::ifstream status("/proc/self/status");
+  for (std::string line; std::getline(status, line);) {
+    if (line.rfind("CapEff:", 0) == 0) {
+      const std::uint64_t capabilities = std::stoull(line.substr(7), nullptr, 16);
+      return (capabilities >> capability) & 1;
+    }
+  }
+  return false;
+}
+
+}
+
+std::vector<int> ParseCpuList(const std::string& cpu_list) {
+  std::vector<int> cpus;
+  std::stringstream stream(cpu_list);
+  for (std::string range; std::getline(stream, range, ',');) {
+    if (range.empty()) {
+      continue;
+    }
+    try {
+      const auto separator = range.find('-');
+      const int first = std::stoi(range.substr(0, separator));
+      const int last = separator == std::string::npos ? first : std::stoi(range.substr(separator + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } catch (const std::exception&) {
+      spdlog::error("[Realtime] Invalid CPU list: {}", cpu_list);
+      return {};
+    }
+  }
+  return cpus;
+}
+
+bool ConfigureCurrentThread(std::string_view name, const ThreadConfig& config) {
+  bool success = true;
+  // The main thread's name is the process name used by pkill, pidof and top.
+  if (syscall(SYS_gettid) != getpid()) {
+    const std::string thread_name = fmt::format("wc-{}", name).substr(0, 15);
+    pthread_setname_np(pthread_self(), thread_name.c_str());
+  }
+
+  if (!config.cpus.empty()) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (const int cpu : config.cpus) {
+      CPU_SET(cpu, &cpu_set);
+    }
+
+    if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        error != 0) {
+      spdlog::error("[Realtime] Failed to pin {} thread to CPUs {}: {}",
+                    name, FormatCpuList(config.cpus), std::strerror(error));
+      success = false;
+    } else {
+      spdlog::info("[Realtime] Pinned {} thread to CPUs {}", name, FormatCpuList(config.cpus));
+    }
+  }
+
+  if (config.priority > 0) {
+    sched_param parameters{};
+    parameters.sched_priority = config.priority;
+    if (const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+        error != 0) {
+      spdlog::error("[Realtime] Failed to set SCHED_FIFO priority {} for {} thread: {}",
+                    config.priority, name, std::strerror(error));
+      success = false;
+    } else {
+      spdlog::info("[Realtime] Running {} thread with SCHED_FIFO priority {}",
+                   name, config.priority);
+    }
+  }
+
+  return success;
+}
+
+bool LockMemory() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+      !HasEffectiveCapability(CAP_IPC_LOCK)) {
+    spdlog::error("[Realtime] Refusing to lock memory with RLIMIT_MEMLOCK at {} KiB: thread "
+                  "stacks would exhaust it. Run with 'ulimit -l unlimited' (memlock in "
+                  "limits.conf, LimitMEMLOCK=infinity for systemd) or grant CAP_IPC_LOCK",
+                  limit.rlim_cur / 1024);
+    return false;
+  }
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    spdlog::error("[Realtime] Failed to lock memory: {} (check RLIMIT_MEMLOCK or CAP_IPC_LOCK)",
+                  std::strerror(errno));
+    return false;
+  }
+  spdlog::info("[Realtime] Locked memory");
+  return true;
+}
+
+PriorityInheritanceMutex::PriorityInheritanceMutex() {
+  pthread_mutexattr_t attributes;
+  pthread_mutexattr_init(&attributes);
+  if (const int error = pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+      error != 0) {
+    spdlog::warn("[Realtime] Priority inheritance is not supported: {}", std::strerror(error));
+  }
+  if (const int error = pthread_mutex_init(&m_mutex, &attributes); error != 0) {
+    pthread_mutexattr_destroy(&attributes);
+    throw std::system_error(error, std::generic_category(), "pthread_mutex_init");
+  }
+  pthread_mutexattr_destroy(&attributes);
+}
+
+PriorityInheritanceMutex::~PriorityInheritanceMutex() {
+  pthread_mutex_destroy(&m_mutex);
+}
+
+void PriorityInheritanceMutex::lock() {
+  if (const int error = pthread_mutex_lock(&m_mutex); error != 0) {
+    throw std::system_error(error, std::generic_category(), "pthread_mutex_lock");
+  }
+}
+
+bool PriorityInheritanceMutex::try_lock() {
+  return pthread_mutex_trylock(&m_mutex) == 0;
+}
+
+void PriorityInheritanceMutex::unlock() {
+  pthread_mutex_unlock(&m_mutex);
+}
+
+void PrefaultStack() {
+  [[maybe_unused]] volatile unsigned char stack[kPrefaultStackSize];
+  for (std::size_t i = 0; i < kPrefaultStackSize; i += 4096) {
+    stack[i] = 0;
+  }
+}
+
+void SleepUntil(std::chrono::steady_clock::time_point time_point) {
+  // steady_clock is CLOCK_MONOTONIC on the platforms we support.
+  const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time_point.time_since_epoch()).count();
+  timespec deadline;
+  deadline.tv_sec = nanoseconds / 1'000'000'000;
+  deadline.tv_nsec = nanoseconds % 1'000'000'000;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+  }
+}
+
+bool RunWakeupLatencyTest(const Options& options, std::chrono::seconds duration) {
+  using Clock = std::chrono::steady_clock;
+  const auto delta_time = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / options.update_rate));
+  const auto budget = std::chrono::duration_cast<Clock::duration>(delta_time * kLatencyBudgetFraction);
+  const std::size_t num_wakeups = std::max<std::size_t>(1, duration / delta_time);
+
+  spdlog::info("[Realtime] Measuring wakeup latency at {}Hz for {}s", options.update_rate,
+               duration.count());
+
+  struct Role {
+    std::string_view name;
+    const ThreadConfig& config;
+    std::vector<Clock::duration> latencies;
+  };
+  Role roles[] = {
+    { "receive", options.receive_thread, {} },
+    { "update", options.update_thread, {} },
+    { "io", options.io_thread, {} },
+  };
+
+  std::vector<std::thread> threads;
+  for (Role& role : roles) {
+    threads.emplace_back([&role, delta_time, num_wakeups]() {
+      ConfigureCurrentThread(role.name, role.config);
+      PrefaultStack();
+      role.latencies.reserve(num_wakeups);
+
+      auto deadline = Clock::now() + delta_time;
+      for (std::size_t i = 0; i < num_wakeups; ++i) {
+        SleepUntil(deadline);
+        role.latencies.push_back(Clock::now() - deadline);
+        deadline += delta_time;
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const auto to_microseconds = [](Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+
+  bool meets_budget = true;
+  for (Role& role : roles) {
+    auto& latencies = role.latencies;
+    std::sort(latencies.begin(), latencies.end());
+
+    const auto average = std::accumulate(latencies.begin(), latencies.end(), Clock::duration::zero()) /
+                         latencies.size();
+    const auto p99 = latencies[latencies.size() * 99 / 100];
+    const auto max = latencies.back();
+    const bool role_meets_budget = max <= budget;
+    meets_budget = meets_budget && role_meets_budget;
+
+    spdlog::log(role_meets_budget ? spdlog::level::info : spdlog::level::warn,
+                "[Realtime] {} thread wakeup latency: min {:.1f}us, avg {:.1f}us, p99 {:.1f}us, "
+                "max {:.1f}us (budget {:.1f}us)",
+                role.name, to_microseconds(latencies.front()), to_microseconds(average),
+                to_microseconds(p99), to_microseconds(max), to_microseconds(budget));
+  }
+
+  if (meets_budget) {
+    spdlog::info("[Realtime] Host configuration meets the frame budget");
+  } else {
+    spdlog::warn("[Realtime] Host configuration does not meet the frame budget");
+  }
+  return meets_budget;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pthread.h>
+
+#include "options.hpp"
+
+// Parses a list of CPUs like "2,3" or "4-7".
+std::vector<int> ParseCpuList(const std::string& cpu_list);
+
+// Pins the calling thread to the configured CPUs and switches it to
+// SCHED_FIFO if a priority is set. Failures are logged and reported.
+bool ConfigureCurrentThread(std::string_view name, const ThreadConfig& config);
+
+// Locks all current and future pages of the process into memory. Every
+// thread stack is locked in full as well, so this refuses to lock anything
+// unless RLIMIT_MEMLOCK is unlimited or the process has CAP_IPC_LOCK:
+// with a finite limit, creating threads would start to fail later on.
+bool LockMemory();
+
+// Touches the top of the calling thread's stack so that page faults do not
+// happen later in the time-critical loop.
+void PrefaultStack();
+
+// Sleeps until the given point in time using an absolute deadline, which
+// avoids the drift of computing a relative timeout first.
+void SleepUntil(std::chrono::steady_clock::time_point time_point);
+
+// A mutex with priority inheritance: while a SCHED_FIFO thread waits for
+// it, the owner runs at the waiter's priority. With a plain mutex, a
+// lower-priority owner could be preempted by unrelated threads and keep
+// the real-time thread waiting for an unbounded time.
+class PriorityInheritanceMutex {
+ public:
+  PriorityInheritanceMutex();
+  ~PriorityInheritanceMutex();
+
+  PriorityInheritanceMutex(const PriorityInheritanceMutex&) = delete;
+  PriorityInheritanceMutex& operator=(const PriorityInheritanceMutex&) = delete;
+
+  void lock();
+  bool try_lock();
+  void unlock();
+
+ private:
+  pthread_mutex_t m_mutex;
+};
+
+// Measures how late each thread role wakes up from an absolute sleep at the
+// update rate and reports whether this fits into the frame budget.
+bool RunWakeupLatencyTest(const Options& options, std::chrono::seconds duration);
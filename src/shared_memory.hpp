@@ -0,0 +1,285 @@
+#pragma once
+
+// Layout of the shared-memory output and a header-only reader for it. Render
+// processes on the same host can include this file together with
+// binary_frame.hpp to read poses without going through the WebSocket.
+//
+// The segment starts with a SharedMemoryHeader followed by a ring of
+// SharedMemorySlots. Each slot is protected by a seqlock: the writer makes
+// the sequence odd, copies the frame and makes it even again. Readers retry
+// if the sequence was odd or changed while they were copying.
+//
+// Readers blocked in WaitForFrame() are counted in the header so the writer
+// can skip the FUTEX_WAKE syscall while nobody waits. A reader that is killed
+// while waiting leaves the count raised; this only costs the writer one
+// unnecessary syscall per frame until the segment is recreated.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "binary_frame.hpp"
+
+constexpr std::uint32_t kSharedMemoryMagic = 0x48534357; // "WCSH"
+constexpr std::uint32_t kSharedMemoryVersion = 2;
+
+struct alignas(64) SharedMemoryHeader {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t num_slots;
+  std::uint32_t slot_size;
+  // Process id of the writer, so a second server does not replace a segment
+  // that is still in use.
+  std::uint32_t writer_pid;
+
+  // Number of frames written so far. Frame n lives in slot n % num_slots.
+  alignas(64) std::atomic<std::uint64_t> frames_written;
+
+  // Futex word that is incremented after every frame.
+  std::atomic<std::uint32_t> frame_signal;
+
+  // Number of readers blocked in WaitForFrame(). The writer only issues a
+  // FUTEX_WAKE if this is non-zero.
+  std::atomic<std::uint32_t> waiters;
+};
+
+struct alignas(64) SharedMemorySlot {
+  // Odd while the writer is updating the slot. Each write adds 2, so after
+  // frame n has been written the sequence is 2 * (n / num_slots + 1).
+  std::atomic<std::uint32_t> sequence;
+  BinaryFrame frame;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+inline std::size_t SharedMemorySize(std::uint32_t num_slots) {
+  return sizeof(SharedMemoryHeader) + num_slots * sizeof(SharedMemorySlot);
+}
+
+inline SharedMemorySlot* SharedMemorySlots(SharedMemoryHeader* header) {
+  return reinterpret_cast<SharedMemorySlot*>(header + 1);
+}
+
+inline const SharedMemorySlot* SharedMemorySlots(const SharedMemoryHeader* header) {
+  return reinterpret_cast<const SharedMemorySlot*>(header + 1);
+}
+
+inline void SharedMemoryWake(SharedMemoryHeader* header) {
+#ifdef __linux__
+  if (header->waiters.load() > 0) {
+    syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&header->frame_signal),
+            FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+  }
+#endif
+}
+
+class SharedMemoryReader {
+ public:
+  SharedMemoryReader() = default;
+  explicit SharedMemoryReader(const std::string& name) { Open(name); }
+  ~SharedMemoryReader() { Close(); }
+
+  SharedMemoryReader(const SharedMemoryReader&) = delete;
+  SharedMemoryReader& operator=(const SharedMemoryReader&) = delete;
+
+  // Readers need write access to register as waiters. If the segment can
+  // only be opened read-only, WaitForFrame() falls back to polling.
+  bool Open(const std::string& name) {
+    Close();
+
+    m_writable = true;
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      m_writable = false;
+      fd = shm_open(name.c_str(), O_RDONLY, 0);
+    }
+    if (fd < 0) {
+      return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 ||
+        static_cast<std::size_t>(file_stat.st_size) < sizeof(SharedMemoryHeader)) {
+      close(fd);
+      return false;
+    }
+
+    const int protection = m_writable ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* memory = mmap(nullptr, file_stat.st_size, protection, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+      return false;
+    }
+
+    m_header = static_cast<const SharedMemoryHeader*>(memory);
+    m_size = file_stat.st_size;
+
+    if (m_header->magic != kSharedMemoryMagic ||
+        m_header->version != kSharedMemoryVersion ||
+        m_header->slot_size != sizeof(SharedMemorySlot) ||
+        m_header->num_slots == 0 ||
+        SharedMemorySize(m_header->num_slots) > m_size) {
+      Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Close() {
+    if (m_header) {
+      munmap(const_cast<SharedMemoryHeader*>(m_header), m_size);
+      m_header = nullptr;
+      m_size = 0;
+    }
+  }
+
+  bool IsOpen() const { return m_header != nullptr; }
+
+  std::uint64_t FramesWritten() const {
+    return m_header->frames_written.load(std::memory_order_acquire);
+  }
+
+  // Copies frame number `index` (counted from zero since the server started)
+  // if it has been written and not yet been overwritten by the ring. Gives
+  // up if the slot stays locked, e.g. because the server died while writing.
+  bool Read(std::uint64_t index, BinaryFrame* frame) const {
+    if (index >= FramesWritten()) {
+      return false;
+    }
+
+    const std::uint32_t num_slots = m_header->num_slots;
+    const SharedMemorySlot& slot = SharedMemorySlots(m_header)[index % num_slots];
+    const std::uint32_t expected_sequence =
+        static_cast<std::uint32_t>(2 * (index / num_slots + 1));
+
+    // Only read the clock if the slot is actually locked, which is rare.
+    std::chrono::steady_clock::time_point deadline;
+    while (true) {
+      const std::uint32_t sequence_before = slot.sequence.load(std::memory_order_acquire);
+      if (sequence_before != expected_sequence) {
+        if (sequence_before == expected_sequence - 1) {
+          // The frame is currently being written.
+          const auto now = std::chrono::steady_clock::now();
+          if (deadline == std::chrono::steady_clock::time_point{}) {
+            deadline = now + kMaxReadDuration;
+          }
+          if (now < deadline) {
+            std::this_thread::yield();
+            continue;
+          }
+        }
+        return false;
+      }
+
+      std::memcpy(&frame->header, &slot.frame.header, sizeof(BinaryFrameHeader));
+      const std::uint32_t num_bodies = std::min(frame->header.num_bodies, kBinaryFrameMaxBodies);
+      std::memcpy(frame->bodies, slot.frame.bodies, num_bodies * sizeof(BinaryBody));
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.sequence.load(std::memory_order_relaxed) == sequence_before) {
+        frame->header.num_bodies = num_bodies;
+        return true;
+      }
+    }
+  }
+
+  // Copies the most recently written frame. Returns false if no frame has
+  // been written yet or the latest slot could not be read.
+  bool ReadLatest(BinaryFrame* frame, std::uint64_t* index = nullptr) const {
+    std::uint64_t frames_written = FramesWritten();
+    while (frames_written > 0) {
+      if (Read(frames_written - 1, frame)) {
+        if (index) {
+          *index = frames_written - 1;
+        }
+        return true;
+      }
+
+      // Only retry if the writer has moved on in the meantime.
+      const std::uint64_t previous_frames_written = frames_written;
+      frames_written = FramesWritten();
+      if (frames_written == previous_frames_written) {
+        return false;
+      }
+    }
+    return false;
+  }
+
+  // Blocks until more than `frames_seen` frames have been written or the
+  // timeout expires. Returns true if a new frame is available.
+  bool WaitForFrame(std::uint64_t frames_seen, std::chrono::nanoseconds timeout) const {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + timeout;
+
+    // The header is only written through if the mapping is writable.
+    auto* header = const_cast<SharedMemoryHeader*>(m_header);
+    if (m_writable) {
+      // Register before reading the futex word: a writer that does not see
+      // the waiter has already bumped the word, so FUTEX_WAIT returns at once.
+      header->waiters.fetch_add(1);
+    }
+
+    bool has_frame = false;
+    while (true) {
+      const std::uint32_t signal = header->frame_signal.load();
+      if (FramesWritten() > frames_seen) {
+        has_frame = true;
+        break;
+      }
+
+      auto remaining = deadline - Clock::now();
+      if (remaining <= Clock::duration::zero()) {
+        break;
+      }
+      if (!m_writable) {
+        // Nobody wakes unregistered readers, so poll.
+        remaining = std::min<Clock::duration>(remaining, kReadOnlyPollInterval);
+      }
+
+#ifdef __linux__
+      const auto remaining_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining);
+      timespec relative_timeout;
+      relative_timeout.tv_sec = remaining_ns.count() / 1'000'000'000;
+      relative_timeout.tv_nsec = remaining_ns.count() % 1'000'000'000;
+
+      syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&header->frame_signal),
+              FUTEX_WAIT, signal, &relative_timeout, nullptr, 0);
+#else
+      (void)signal;
+      std::this_thread::yield();
+#endif
+    }
+
+    if (m_writable) {
+      header->waiters.fetch_sub(1);
+    }
+    return has_frame;
+  }
+
+ private:
+  static constexpr std::chrono::milliseconds kMaxReadDuration{1};
+  static constexpr std::chrono::milliseconds kReadOnlyPollInterval{1};
+
+  const SharedMemoryHeader* m_header = nullptr;
+  std::size_t m_size = 0;
+  bool m_writable = false;
+};
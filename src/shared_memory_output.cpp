@@ -0,0 +1,138 @@
+#include "shared_memory_output.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <signal.h>
+#include <sys/stat.h>
+
+#include "spdlog/spdlog.h"
+
+namespace {
+
+// Returns the pid of the process that still publishes into the existing
+// segment `name`, or 0 if there is no such segment or its writer is gone.
+pid_t LiveWriterPid(const std::string& name) {
+  const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    return 0;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 ||
+      static_cast<std::size_t>(file_stat.st_size) < sizeof(SharedMemoryHeader)) {
+    close(fd);
+    return 0;
+  }
+
+  void* memory = mmap(nullptr, sizeof(SharedMemoryHeader), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    return 0;
+  }
+
+  const auto* header = static_cast<const SharedMemoryHeader*>(memory);
+  pid_t writer_pid = 0;
+  if (header->magic == kSharedMemoryMagic && header->version == kSharedMemoryVersion) {
+    writer_pid = static_cast<pid_t>(header->writer_pid);
+  }
+  munmap(memory, sizeof(SharedMemoryHeader));
+
+  // EPERM means the process exists but belongs to another user.
+  if (writer_pid > 0 && (kill(writer_pid, 0) == 0 || errno == EPERM)) {
+    return writer_pid;
+  }
+  return 0;
+}
+
+}
+
+SharedMemoryOutput::SharedMemoryOutput(const std::string& name, std::uint32_t num_slots)
+  : m_name(name), m_size(SharedMemorySize(num_slots)) {
+  if (num_slots == 0) {
+    spdlog::error("[SharedMemory] At least one slot is required");
+    return;
+  }
+
+  if (const pid_t writer_pid = LiveWriterPid(m_name); writer_pid != 0) {
+    spdlog::error("[SharedMemory] {} is in use by process {}, choose another name with --shm",
+                  m_name, writer_pid);
+    return;
+  }
+
+  // Remove segments left behind by a previous instance, readers that still
+  // have them mapped keep their (stale) copy until they reopen.
+  shm_unlink(m_name.c_str());
+
+  // Readers that can open the segment read-write register as futex waiters,
+  // read-only readers fall back to polling.
+  const int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0664);
+  if (fd < 0) {
+    spdlog::error("[SharedMemory] Failed to create {}: {}", m_name, std::strerror(errno));
+    return;
+  }
+
+  if (ftruncate(fd, m_size) != 0) {
+    spdlog::error("[SharedMemory] Failed to resize {}: {}", m_name, std::strerror(errno));
+    close(fd);
+    shm_unlink(m_name.c_str());
+    return;
+  }
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;
+#endif
+  void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    spdlog::error("[SharedMemory] Failed to map {}: {}", m_name, std::strerror(errno));
+    shm_unlink(m_name.c_str());
+    return;
+  }
+
+  // The segment is zero-initialized by ftruncate, so all sequences start at
+  // zero and no frame has been written yet.
+  m_header = new (memory) SharedMemoryHeader{};
+  m_header->num_slots = num_slots;
+  m_header->slot_size = sizeof(SharedMemorySlot);
+  m_header->writer_pid = static_cast<std::uint32_t>(getpid());
+  m_header->version = kSharedMemoryVersion;
+  std::atomic_thread_fence(std::memory_order_release);
+  m_header->magic = kSharedMemoryMagic;
+
+  spdlog::info("[SharedMemory] Publishing frames to {} ({} slots, {} bytes)",
+               m_name, num_slots, m_size);
+}
+
+SharedMemoryOutput::~SharedMemoryOutput() {
+  if (m_header) {
+    munmap(m_header, m_size);
+    shm_unlink(m_name.c_str());
+  }
+}
+
+void SharedMemoryOutput::Publish(const BinaryFrame& frame) {
+  if (!m_header) {
+    return;
+  }
+
+  const std::uint64_t index = m_header->frames_written.load(std::memory_order_relaxed);
+  SharedMemorySlot& slot = SharedMemorySlots(m_header)[index % m_header->num_slots];
+
+  const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::memcpy(&slot.frame.header, &frame.header, sizeof(BinaryFrameHeader));
+  std::memcpy(slot.frame.bodies, frame.bodies,
+              frame.header.num_bodies * sizeof(BinaryBody));
+
+  slot.sequence.store(sequence + 2, std::memory_order_release);
+  m_header->frames_written.store(index + 1, std::memory_order_release);
+  // Sequentially consistent so the waiter count read by SharedMemoryWake()
+  // cannot be reordered before the increment.
+  m_header->frame_signal.fetch_add(1);
+  SharedMemoryWake(m_header);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "binary_frame.hpp"
+#include "shared_memory.hpp"
+
+// Publishes frames into a POSIX shared-memory segment that can be read with
+// the SharedMemoryReader from shared_memory.hpp.
+class SharedMemoryOutput {
+ public:
+  SharedMemoryOutput(const std::string& name, std::uint32_t num_slots);
+  ~SharedMemoryOutput();
+
+  SharedMemoryOutput(const SharedMemoryOutput&) = delete;
+  SharedMemoryOutput& operator=(const SharedMemoryOutput&) = delete;
+
+  bool IsValid() const { return m_header != nullptr; }
+
+  void Publish(const BinaryFrame& frame);
+
+ private:
+  std::string m_name;
+  std::size_t m_size = 0;
+  SharedMemoryHeader* m_header = nullptr;
+};
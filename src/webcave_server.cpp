@@ -1,12 +1,33 @@
 #include "webcave_server.hpp"
 
 #include <chrono>
+#include "binary_frame_encoder.hpp"
+#include "realtime.hpp"
 #include "spdlog/fmt/bundled/core.h"
 #include "spdlog/spdlog.h"
 #include "websocketpp/connection.hpp"
 
 WebCaveServer::WebCaveServer(const Options& options)
-  : m_options(options), m_dtrack(options.dtrack_connection) {
+  : m_options(options) {
+#ifdef WEBCAVE_WEBRTC
+  // libdatachannel starts its thread pool on first use. Start it here on the
+  // main thread, otherwise the pool would be spawned lazily by the io thread
+  // on the first rtcRequest and inherit its real-time priority and CPU mask.
+  rtc::Preload();
+#endif
+  if (m_options.upstream.empty()) {
+    m_dtrack.emplace(m_options.dtrack_connection, m_options.receive_thread);
+  } else if (!m_options.dtrack_connection.empty()) {
+    spdlog::warn("[Relay] Ignoring --dtrack {}, frames are relayed from upstream {}",
+                 m_options.dtrack_connection, m_options.upstream);
+  }
+  if (!m_options.shared_memory_name.empty()) {
+    m_shared_memory_output.emplace(m_options.shared_memory_name, m_options.shared_memory_slots);
+  }
+  if (!m_options.multicast_group.empty()) {
+    m_multicast_output.emplace(m_options.multicast_group, m_options.multicast_port,
+                               m_options.multicast_ttl, m_options.multicast_interface);
+  }
 }
 
 WebCaveServer::~WebCaveServer() {
@@ -17,24 +38,59 @@ int WebCaveServer::Run() {
   m_websocket_server.init_asio();
 
   m_websocket_server.set_open_handler([this](const auto& connection) {
-      std::unique_lock<std::mutex> lock(m_connections_mutex);
+      std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
       m_connections.insert(std::make_pair(connection, Client{}));
   });
   m_websocket_server.set_close_handler([this](const auto& connection) {
-      std::unique_lock<std::mutex> lock(m_connections_mutex);
-      m_connections.erase(connection);
+      // Destroy the client outside of the lock, closing its WebRTC peer can
+      // block the update thread otherwise.
+      Client client;
+      std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+      if (const auto entry = m_connections.find(connection); entry != m_connections.end()) {
+        client = std::move(entry->second);
+        m_connections.erase(entry);
+      }
+      lock.unlock();
   });
   m_websocket_server.set_message_handler([this](const auto& connection_handle, const auto& message) {
-    assert(m_connections.find(connection_handle) != m_connections.end());
-    // m_connections[connection_handle].fra
+    HandleMessage(connection_handle, message->get_payload());
   });
 
   spdlog::info("Starting server on port {}", m_options.port);
   m_websocket_server.listen(m_options.port);
   m_websocket_server.start_accept();
 
-  m_update_thread = std::thread(&WebCaveServer::UpdateThread, this);
-  m_websocket_server.run();
+  if (m_options.upstream.empty()) {
+    m_update_thread = std::thread(&WebCaveServer::UpdateThread, this);
+  } else {
+    m_upstream_client.init_asio(&m_websocket_server.get_io_service());
+    m_upstream_client.set_open_handler([this](const auto& connection) {
+      spdlog::info("[Relay] Connected to upstream {}", m_options.upstream);
+      m_upstream_connection = connection;
+    });
+    m_upstream_client.set_fail_handler([this](const auto&) {
+      spdlog::warn("[Relay] Failed to connect to upstream {}", m_options.upstream);
+      ScheduleUpstreamReconnect();
+    });
+    m_upstream_client.set_close_handler([this](const auto&) {
+      spdlog::warn("[Relay] Lost connection to upstream {}", m_options.upstream);
+      ScheduleUpstreamReconnect();
+    });
+    m_upstream_client.set_message_handler([this](const auto&, const auto& message) {
+      RelayMessage(message->get_payload(), message->get_opcode());
+    });
+    ConnectUpstream();
+  }
+
+  // Run the io context on its own thread so the io role's name, priority and
+  // CPU mask are not applied to the main thread, which gives the process
+  // its name and spawns the other threads.
+  m_io_thread = std::thread([this]() {
+    ConfigureCurrentThread("io", m_options.io_thread);
+    PrefaultStack();
+    m_websocket_server.run();
+  });
+  m_io_thread.join();
 
   return EXIT_SUCCESS;
 }
@@ -44,21 +100,37 @@ void WebCaveServer::Stop() {
 
   if (!m_quit) {
     m_quit = true;
-    m_update_thread.join();
+    if (m_update_thread.joinable()) {
+      m_update_thread.join();
+    }
 
-    {
-      std::unique_lock<std::mutex> lock(m_connections_mutex);
-      for (const auto& [connection_handle, x] : m_connections) {
-        m_websocket_server.close(connection_handle, 1001, "Server shutdown");
+    // Stop() runs on the signal handling thread, but m_upstream_connection is
+    // only ever touched by the io thread. Shut down from there, stopping the
+    // io context right away would drop the posted handler.
+    asio::post(m_websocket_server.get_io_service(), [this]() {
+      if (!m_upstream_connection.expired()) {
+        websocketpp::lib::error_code error;
+        m_upstream_client.close(m_upstream_connection, 1001, "Relay shutdown", error);
       }
-      m_connections.clear();
-    }
-    m_websocket_server.stop();
+
+      {
+        std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+        // Must not throw, an exception would escape the io thread.
+        for (const auto& [connection_handle, x] : m_connections) {
+          websocketpp::lib::error_code error;
+          m_websocket_server.close(connection_handle, 1001, "Server shutdown", error);
+        }
+        m_connections.clear();
+      }
+      m_websocket_server.stop();
+    });
   }
 }
 
 void WebCaveServer::UpdateThread() {
   spdlog::info("Running updates at {}Hz", m_options.update_rate);
+  ConfigureCurrentThread("update", m_options.update_thread);
+  PrefaultStack();
 
   using Clock = std::chrono::steady_clock;
   const auto delta_time = std::chrono::duration_cast<Clock::duration>(
@@ -68,6 +140,10 @@ void WebCaveServer::UpdateThread() {
 
   auto time_last_frame = Clock::now();
   while (!m_quit.load(std::memory_order_relaxed)) {
+    // Sleep until the next frame is due instead of spinning. A spinning
+    // thread with SCHED_FIFO priority would starve everything else on its CPU.
+    SleepUntil(time_last_frame + delta_time);
+
     const auto now = Clock::now();
     if (now - time_last_frame >= delta_time) {
       fmt::print("\rFrame: {}, Time: {:0.3}", m_current_frame, time);
@@ -76,16 +152,30 @@ void WebCaveServer::UpdateThread() {
       // delta_time to it to avoid slow drift over time.
       time_last_frame += delta_time;
 
-      if (std::unique_lock<std::mutex> connections_lock(m_connections_mutex);
-          !m_connections.empty()) {
-        connections_lock.unlock();
-        Broadcast({
-          { "type", "startFrame" },
-          { "frame", m_current_frame },
-          { "time", time },
-          { "deltaTime", 1.0 / m_options.update_rate },
-          { "trackingData", m_dtrack.tracking_data() },
-        });
+      std::unique_lock<PriorityInheritanceMutex> connections_lock(m_connections_mutex);
+      const bool has_connections = !m_connections.empty();
+      connections_lock.unlock();
+
+      const bool has_binary_outputs = m_shared_memory_output || m_multicast_output;
+
+      if (has_connections || has_binary_outputs) {
+        const nlohmann::json tracking_data = m_dtrack->tracking_data();
+
+        if (has_binary_outputs) {
+          EncodeBinaryFrame(m_current_frame, time, 1.0 / m_options.update_rate,
+                            tracking_data, &m_binary_frame);
+          PublishBinaryFrame();
+        }
+
+        if (has_connections) {
+          Broadcast({
+            { "type", "startFrame" },
+            { "frame", m_current_frame },
+            { "time", time },
+            { "deltaTime", 1.0 / m_options.update_rate },
+            { "trackingData", tracking_data },
+          });
+        }
         ++m_current_frame;
         time = m_current_frame / m_options.update_rate;
       }
@@ -93,13 +183,165 @@ void WebCaveServer::UpdateThread() {
   }
 }
 
-void WebCaveServer::Broadcast(const nlohmann::json& message) {
+void WebCaveServer::HandleMessage(const websocketpp::connection_hdl& connection_handle,
+                                  const std::string& payload) {
+  // Client messages are untrusted, nothing in here may throw out of the
+  // websocketpp handler.
+  const auto message = nlohmann::json::parse(payload, nullptr, false);
+  if (!message.is_object()) {
+    return;
+  }
+  const auto type_field = message.find("type");
+  if (type_field == message.end() || !type_field->is_string()) {
+    return;
+  }
+  const std::string& type = type_field->get_ref<const std::string&>();
+
+#ifdef WEBCAVE_WEBRTC
+  try {
+    if (type == "rtcRequest") {
+      auto send_signaling = [this, connection_handle](const nlohmann::json& signaling_message) {
+        SendMessage(connection_handle, signaling_message);
+      };
+
+      std::shared_ptr<WebRtcPeer> webrtc_peer;
+      {
+        std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+        const auto client = m_connections.find(connection_handle);
+        if (client == m_connections.end()) {
+          return;
+        }
+        webrtc_peer = client->second.webrtc_peer;
+      }
+      // Repeated requests must not tear down a connection that is still
+      // being negotiated or already carries frames.
+      if (webrtc_peer && webrtc_peer->IsActive()) {
+        spdlog::warn("[WebRTC] Ignoring rtcRequest, the client already has an active peer");
+        return;
+      }
+
+      // Closing a peer connection can block, so both the new and the old
+      // peer are constructed and destroyed outside of the lock.
+      auto new_webrtc_peer = std::make_shared<WebRtcPeer>(m_options.ice_server, send_signaling);
+      {
+        std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+        if (const auto client = m_connections.find(connection_handle); client != m_connections.end()) {
+          std::swap(client->second.webrtc_peer, new_webrtc_peer);
+        }
+      }
+    } else if (type == "rtcDescription" || type == "rtcCandidate") {
+      std::shared_ptr<WebRtcPeer> webrtc_peer;
+      {
+        std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+        if (const auto client = m_connections.find(connection_handle); client != m_connections.end()) {
+          webrtc_peer = client->second.webrtc_peer;
+        }
+      }
+      if (webrtc_peer) {
+        webrtc_peer->HandleSignaling(message);
+      }
+    }
+  } catch (const std::exception& error) {
+    spdlog::error("[WebRTC] {}", error.what());
+  }
+#else
+  if (type == "rtcRequest") {
+    SendMessage(connection_handle, {{ "type", "rtcUnavailable" }});
+  }
+#endif
+}
+
+void WebCaveServer::SendMessage(const websocketpp::connection_hdl& connection_handle,
+                                const nlohmann::json& message) {
   const std::string data = message.dump();
-  std::unique_lock<std::mutex> lock(m_connections_mutex);
-  for (const auto& [connection_handle, x] : m_connections) {
+  websocketpp::lib::error_code error;
+  m_websocket_server.send(connection_handle, data, websocketpp::frame::opcode::TEXT, error);
+  if (error) {
+    spdlog::error("{}", error.message());
+  }
+}
+
+void WebCaveServer::ConnectUpstream() {
+  websocketpp::lib::error_code error;
+  const auto connection = m_upstream_client.get_connection(m_options.upstream, error);
+  if (error) {
+    spdlog::error("[Relay] Invalid upstream {}: {}", m_options.upstream, error.message());
+    return;
+  }
+
+  spdlog::info("[Relay] Connecting to upstream {}", m_options.upstream);
+  m_upstream_client.connect(connection);
+}
+
+void WebCaveServer::ScheduleUpstreamReconnect() {
+  if (m_quit) {
+    return;
+  }
+
+  m_upstream_client.set_timer(1000, [this](const websocketpp::lib::error_code& error) {
+    if (!error && !m_quit) {
+      ConnectUpstream();
+    }
+  });
+}
+
+void WebCaveServer::RelayMessage(const std::string& payload,
+                                 websocketpp::frame::opcode::value opcode) {
+  // Forward the payload as-is, frame numbers and timestamps are the ones
+  // assigned by the upstream server.
+  Broadcast(payload, opcode);
+
+  // The binary outputs need the decoded frame, so only pay for parsing if
+  // one of them is enabled.
+  if (m_shared_memory_output || m_multicast_output) {
+    const auto message = nlohmann::json::parse(payload, nullptr, false);
+    if (!message.is_object()) {
+      return;
+    }
+
+    // The upstream may run a different version, a frame that does not
+    // decode is skipped instead of taking down the relay.
+    try {
+      if (message.value("type", "") != "startFrame") {
+        return;
+      }
+
+      EncodeBinaryFrame(message.value("frame", std::uint64_t{0}), message.value("time", 0.0),
+                        message.value("deltaTime", 0.0),
+                        message.value("trackingData", nlohmann::json()), &m_binary_frame);
+    } catch (const nlohmann::json::exception& error) {
+      spdlog::error("[Relay] Skipping malformed upstream frame: {}", error.what());
+      return;
+    }
+    PublishBinaryFrame();
+  }
+}
+
+void WebCaveServer::PublishBinaryFrame() {
+  if (m_shared_memory_output) {
+    m_shared_memory_output->Publish(m_binary_frame);
+  }
+  if (m_multicast_output) {
+    m_multicast_output->Publish(m_binary_frame);
+  }
+}
+
+void WebCaveServer::Broadcast(const nlohmann::json& message) {
+  Broadcast(message.dump(), websocketpp::frame::opcode::TEXT);
+}
+
+void WebCaveServer::Broadcast(const std::string& data,
+                              websocketpp::frame::opcode::value opcode) {
+  std::unique_lock<PriorityInheritanceMutex> lock(m_connections_mutex);
+  for (const auto& [connection_handle, client] : m_connections) {
+#ifdef WEBCAVE_WEBRTC
+    if (client.webrtc_peer && client.webrtc_peer->IsOpen() &&
+        client.webrtc_peer->Send(data)) {
+      continue;
+    }
+#endif
     try {
-      m_websocket_server.send(connection_handle, data.data(), data.size(),
-                              websocketpp::frame::opcode::TEXT);
+      m_websocket_server.send(connection_handle, data.data(), data.size(), opcode);
     } catch (const websocketpp::exception& error) {
       spdlog::error("{}", error.what());
     }
@@ -3,17 +3,34 @@
 #include <atomic>
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <optional>
 #include <thread>
 
+#include "binary_frame.hpp"
 #include "dtrack.hpp"
+#include "multicast_output.hpp"
 #include "options.hpp"
+#include "realtime.hpp"
+#include "shared_memory_output.hpp"
+#include "websocketpp/client.hpp"
 #include "websocketpp/server.hpp"
 #include "websocketpp/config/asio_no_tls.hpp"
+#include "websocketpp/config/asio_no_tls_client.hpp"
 #include "nlohmann/json.hpp"
 
+#ifdef WEBCAVE_WEBRTC
+#include "webrtc_peer.hpp"
+#endif
+
 struct Client {
   std::optional<std::uint64_t> frame;
+
+#ifdef WEBCAVE_WEBRTC
+  // Frames are sent over the peer's DataChannel instead of the WebSocket
+  // while it is open.
+  std::shared_ptr<WebRtcPeer> webrtc_peer;
+#endif
 };
 
 class WebCaveServer {
@@ -30,16 +47,36 @@ class WebCaveServer {
   std::atomic<bool> m_quit = false;
   void UpdateThread();
   std::thread m_update_thread;
+  std::thread m_io_thread;
 
   using ServerType = websocketpp::server<websocketpp::config::asio>;
   ServerType m_websocket_server;
 
-  std::mutex m_connections_mutex;
+  // Taken by the SCHED_FIFO update thread and the io thread.
+  PriorityInheritanceMutex m_connections_mutex;
   std::map<websocketpp::connection_hdl, Client, std::owner_less<websocketpp::connection_hdl>> m_connections;
 
-  DTrack m_dtrack;
+  // Relay mode: frames are received from an upstream server instead.
+  using UpstreamClientType = websocketpp::client<websocketpp::config::asio_client>;
+  UpstreamClientType m_upstream_client;
+  websocketpp::connection_hdl m_upstream_connection;
+  void ConnectUpstream();
+  void ScheduleUpstreamReconnect();
+  void RelayMessage(const std::string& payload, websocketpp::frame::opcode::value opcode);
+
+  std::optional<DTrack> m_dtrack;
+  std::optional<SharedMemoryOutput> m_shared_memory_output;
+  std::optional<MulticastOutput> m_multicast_output;
+  BinaryFrame m_binary_frame;
 
   std::uint64_t m_current_frame = 0;
 
+  void HandleMessage(const websocketpp::connection_hdl& connection_handle,
+                     const std::string& payload);
+  void SendMessage(const websocketpp::connection_hdl& connection_handle,
+                   const nlohmann::json& message);
+
+  void PublishBinaryFrame();
   void Broadcast(const nlohmann::json& message);
+  void Broadcast(const std::string& data, websocketpp::frame::opcode::value opcode);
 };
@@ -0,0 +1,87 @@
+#include "webrtc_peer.hpp"
+
+#include "spdlog/spdlog.h"
+
+WebRtcPeer::WebRtcPeer(const std::string& ice_server, SignalingCallback send_signaling) {
+  rtc::Configuration configuration;
+  if (!ice_server.empty()) {
+    configuration.iceServers.emplace_back(ice_server);
+  }
+
+  m_peer_connection = std::make_shared<rtc::PeerConnection>(configuration);
+  m_peer_connection->onLocalDescription([send_signaling](rtc::Description description) {
+    send_signaling({
+      { "type", "rtcDescription" },
+      { "description", {
+        { "type", description.typeString() },
+        { "sdp", std::string(description) },
+      }},
+    });
+  });
+  m_peer_connection->onLocalCandidate([send_signaling](rtc::Candidate candidate) {
+    send_signaling({
+      { "type", "rtcCandidate" },
+      { "candidate", {
+        { "candidate", std::string(candidate) },
+        { "sdpMid", candidate.mid() },
+      }},
+    });
+  });
+  m_peer_connection->onStateChange([](rtc::PeerConnection::State state) {
+    spdlog::info("[WebRTC] Peer connection state: {}", static_cast<int>(state));
+  });
+
+  // Frames are superseded by the next one anyway, so never wait for
+  // retransmits or reorder: a lost frame must not delay the following ones.
+  rtc::DataChannelInit data_channel_init;
+  data_channel_init.reliability.unordered = true;
+  data_channel_init.reliability.maxRetransmits = 0;
+
+  // Creating the channel starts the negotiation and emits the offer.
+  m_data_channel = m_peer_connection->createDataChannel("frames", data_channel_init);
+}
+
+WebRtcPeer::~WebRtcPeer() {
+  m_data_channel->resetCallbacks();
+  m_peer_connection->resetCallbacks();
+  m_peer_connection->close();
+}
+
+void WebRtcPeer::HandleSignaling(const nlohmann::json& message) {
+  const std::string type = message.at("type");
+
+  if (type == "rtcDescription") {
+    const auto& description = message.at("description");
+    m_peer_connection->setRemoteDescription(rtc::Description(
+        description.at("sdp").get<std::string>(),
+        description.at("type").get<std::string>()));
+  } else if (type == "rtcCandidate") {
+    const auto& candidate = message.at("candidate");
+    const std::string candidate_string = candidate.at("candidate");
+    // An empty candidate signals the end of candidates.
+    if (!candidate_string.empty()) {
+      m_peer_connection->addRemoteCandidate(rtc::Candidate(
+          candidate_string, candidate.value("sdpMid", "")));
+    }
+  }
+}
+
+bool WebRtcPeer::IsActive() const {
+  const auto state = m_peer_connection->state();
+  return state != rtc::PeerConnection::State::Closed &&
+         state != rtc::PeerConnection::State::Failed;
+}
+
+bool WebRtcPeer::IsOpen() const {
+  return m_data_channel->isOpen();
+}
+
+bool WebRtcPeer::Send(const std::string& data) {
+  try {
+    m_data_channel->send(data);
+    return true;
+  } catch (const std::exception& error) {
+    spdlog::error("[WebRTC] {}", error.what());
+    return false;
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "nlohmann/json.hpp"
+#include "rtc/rtc.hpp"
+
+// A WebRTC peer connection to a single client with one unordered, unreliable
+// DataChannel that frames are sent over. Signaling messages are exchanged
+// over the client's WebSocket connection:
+//
+//   {"type": "rtcDescription", "description": {"type": ..., "sdp": ...}}
+//   {"type": "rtcCandidate", "candidate": {"candidate": ..., "sdpMid": ...}}
+//
+// The payloads mirror RTCSessionDescriptionInit and RTCIceCandidateInit so
+// browsers can pass them to the RTCPeerConnection directly.
+class WebRtcPeer {
+ public:
+  using SignalingCallback = std::function<void(const nlohmann::json& message)>;
+
+  WebRtcPeer(const std::string& ice_server, SignalingCallback send_signaling);
+  ~WebRtcPeer();
+
+  WebRtcPeer(const WebRtcPeer&) = delete;
+  WebRtcPeer& operator=(const WebRtcPeer&) = delete;
+
+  // Throws if the message is malformed or rejected by the peer connection.
+  void HandleSignaling(const nlohmann::json& message);
+
+  // True until the peer connection has been closed or has failed, i.e.
+  // while it is still being negotiated or is connected.
+  bool IsActive() const;
+  bool IsOpen() const;
+  bool Send(const std::string& data);
+
+ private:
+  std::shared_ptr<rtc::PeerConnection> m_peer_connection;
+  std::shared_ptr<rtc::DataChannel> m_data_channel;
+};
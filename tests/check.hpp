@@ -0,0 +1,16 @@
+#pragma once
+
+// Minimal assertion for the standalone test executables. Unlike assert() it
+// is not compiled out in release builds.
+
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(condition)                                                      \
+  do {                                                                        \
+    if (!(condition)) {                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,   \
+                   #condition);                                               \
+      std::exit(EXIT_FAILURE);                                                \
+    }                                                                         \
+  } while (false)
@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "check.hpp"
+#include "multicast.hpp"
+#include "multicast_output.hpp"
+
+namespace {
+
+constexpr const char* kGroup = "239.255.42.99";
+constexpr const char* kInterface = "127.0.0.1";
+constexpr std::uint16_t kPort = 5099;
+
+// Sends hand-made datagrams over the loopback interface, for the cases that
+// MulticastOutput cannot produce on purpose: lost and duplicated datagrams.
+class LoopbackSender {
+ public:
+  LoopbackSender() {
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    CHECK(m_socket >= 0);
+
+    in_addr interface_address;
+    CHECK(inet_pton(AF_INET, kInterface, &interface_address) == 1);
+    CHECK(setsockopt(m_socket, IPPROTO_IP, IP_MULTICAST_IF, &interface_address,
+                     sizeof(interface_address)) == 0);
+
+    m_address.sin_family = AF_INET;
+    m_address.sin_port = htons(kPort);
+    CHECK(inet_pton(AF_INET, kGroup, &m_address.sin_addr) == 1);
+  }
+  ~LoopbackSender() { close(m_socket); }
+
+  void Send(std::uint64_t epoch, std::uint64_t sequence) {
+    MulticastPacket packet{};
+    packet.header.magic = kMulticastMagic;
+    packet.header.version = kMulticastVersion;
+    packet.header.epoch = epoch;
+    packet.header.sequence = sequence;
+    packet.frame.header.frame = sequence;
+    packet.frame.header.num_bodies = 1;
+    packet.frame.bodies[0].id = static_cast<std::uint32_t>(sequence);
+    MulticastConvertHeaderByteOrder(&packet);
+    MulticastConvertBodyByteOrder(&packet.frame.bodies[0]);
+
+    const std::size_t size = MulticastPacketSize(1);
+    CHECK(sendto(m_socket, &packet, size, 0, reinterpret_cast<const sockaddr*>(&m_address),
+                 sizeof(m_address)) == static_cast<ssize_t>(size));
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+
+ private:
+  int m_socket = -1;
+  sockaddr_in m_address{};
+};
+
+BinaryFrame MakeFrame(std::uint64_t frame, std::uint32_t num_bodies = 1) {
+  BinaryFrame binary_frame{};
+  binary_frame.header.frame = frame;
+  binary_frame.header.time = frame / 60.0;
+  binary_frame.header.num_bodies = num_bodies;
+  for (std::uint32_t i = 0; i < num_bodies; ++i) {
+    binary_frame.bodies[i].id = i;
+    binary_frame.bodies[i].is_tracked = 1;
+    binary_frame.bodies[i].position[0] = static_cast<float>(frame);
+    binary_frame.bodies[i].orientation[3] = 1.0f;
+  }
+  return binary_frame;
+}
+
+void Publish(MulticastOutput& output, const BinaryFrame& frame) {
+  output.Publish(frame);
+  std::this_thread::sleep_for(std::chrono::microseconds(500));
+}
+
+// Runs `send` on another thread and returns every frame the receiver
+// delivered until the sender has been quiet for a while.
+std::vector<BinaryFrame> ReceiveAll(MulticastReceiver& receiver, std::function<void()> send) {
+  std::thread sender_thread(std::move(send));
+
+  std::vector<BinaryFrame> frames;
+  BinaryFrame frame;
+  while (receiver.Receive(&frame, std::chrono::milliseconds(500))) {
+    frames.push_back(frame);
+  }
+  sender_thread.join();
+  return frames;
+}
+
+void TestSequenceGaps() {
+  MulticastReceiver receiver(kGroup, kPort, kInterface);
+  CHECK(receiver.IsOpen());
+
+  const auto frames = ReceiveAll(receiver, []() {
+    LoopbackSender sender;
+    // Every tenth datagram gets lost.
+    for (std::uint64_t sequence = 0; sequence < 200; ++sequence) {
+      if (sequence % 10 != 9) {
+        sender.Send(1, sequence);
+      }
+      if (sequence == 50) {
+        // A stale duplicate must be skipped.
+        sender.Send(1, 10);
+      }
+    }
+  });
+
+  CHECK(frames.size() == 180);
+  for (std::size_t i = 1; i < frames.size(); ++i) {
+    CHECK(frames[i].header.frame > frames[i - 1].header.frame);
+    CHECK(frames[i].bodies[0].id == frames[i].header.frame);
+  }
+  CHECK(receiver.ReceivedPackets() == 180);
+  // The datagram with sequence 199 is never followed by 200, so only 19
+  // gaps are detectable.
+  CHECK(receiver.LostPackets() == 19);
+}
+
+void TestRestart() {
+  MulticastReceiver receiver(kGroup, kPort, kInterface);
+  CHECK(receiver.IsOpen());
+
+  MulticastOutput first_output(kGroup, kPort, 1, kInterface);
+  MulticastOutput second_output(kGroup, kPort, 1, kInterface);
+  CHECK(first_output.IsValid());
+  CHECK(second_output.IsValid());
+  CHECK(first_output.Epoch() != 0);
+  CHECK(second_output.Epoch() != 0);
+  CHECK(first_output.Epoch() != second_output.Epoch());
+
+  const auto frames = ReceiveAll(receiver, [&]() {
+    for (std::uint64_t i = 0; i < 50; ++i) {
+      Publish(first_output, MakeFrame(i));
+    }
+    // The server restarts, its sequence numbers start from zero again.
+    for (std::uint64_t i = 0; i < 50; ++i) {
+      Publish(second_output, MakeFrame(1000 + i));
+    }
+    // A late datagram of the previous run must not be taken for another
+    // restart.
+    Publish(first_output, MakeFrame(999));
+    for (std::uint64_t i = 50; i < 60; ++i) {
+      Publish(second_output, MakeFrame(1000 + i));
+    }
+  });
+
+  CHECK(frames.size() == 110);
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    const std::uint64_t expected_frame = i < 50 ? i : 1000 + (i - 50);
+    CHECK(frames[i].header.frame == expected_frame);
+    CHECK(frames[i].header.time == expected_frame / 60.0);
+    CHECK(frames[i].header.num_bodies == 1);
+    CHECK(frames[i].bodies[0].position[0] == static_cast<float>(expected_frame));
+  }
+  CHECK(receiver.ReceivedPackets() == 110);
+  CHECK(receiver.LostPackets() == 0);
+}
+
+void TestTruncation() {
+  MulticastReceiver receiver(kGroup, kPort, kInterface);
+  CHECK(receiver.IsOpen());
+
+  MulticastOutput output(kGroup, kPort, 1, kInterface);
+  CHECK(output.IsValid());
+
+  const auto frames = ReceiveAll(receiver, [&]() {
+    Publish(output, MakeFrame(0, kBinaryFrameMaxBodies));
+    Publish(output, MakeFrame(1, kMulticastMaxBodies));
+  });
+
+  CHECK(frames.size() == 2);
+  for (const BinaryFrame& frame : frames) {
+    CHECK(frame.header.num_bodies == kMulticastMaxBodies);
+    for (std::uint32_t i = 0; i < kMulticastMaxBodies; ++i) {
+      CHECK(frame.bodies[i].id == i);
+      CHECK(frame.bodies[i].orientation[3] == 1.0f);
+    }
+  }
+  CHECK(receiver.LostPackets() == 0);
+}
+
+}
+
+int main() {
+  TestSequenceGaps();
+  TestRestart();
+  TestTruncation();
+  std::printf("multicast_test passed\n");
+  return EXIT_SUCCESS;
+}
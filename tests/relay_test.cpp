@@ -0,0 +1,142 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "check.hpp"
+#include "nlohmann/json.hpp"
+#include "websocketpp/client.hpp"
+#include "websocketpp/config/asio_no_tls_client.hpp"
+
+// Starts an upstream server and two relays chained behind it, then checks
+// that the last relay forwards the upstream's frames byte for byte.
+//
+//   upstream (kPort) <- relay (kPort + 1) <- relay (kPort + 2)
+
+namespace {
+
+using ClientType = websocketpp::client<websocketpp::config::asio_client>;
+
+constexpr int kPort = 5200;
+constexpr std::chrono::milliseconds kCollectDuration{5000};
+constexpr std::chrono::milliseconds kReconnectDelay{200};
+constexpr std::size_t kMinCommonFrames = 30;
+
+std::string Uri(int port) {
+  return "ws://127.0.0.1:" + std::to_string(port);
+}
+
+pid_t StartServer(const std::string& server, const std::vector<std::string>& arguments) {
+  const pid_t pid = fork();
+  CHECK(pid >= 0);
+  if (pid == 0) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(server.c_str()));
+    for (const std::string& argument : arguments) {
+      argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    execv(server.c_str(), argv.data());
+    std::perror("execv");
+    _exit(EXIT_FAILURE);
+  }
+  return pid;
+}
+
+void StopServer(pid_t pid) {
+  kill(pid, SIGINT);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (waitpid(pid, nullptr, WNOHANG) == pid) {
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::fprintf(stderr, "Server %d did not stop on SIGINT\n", pid);
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+// Raw startFrame payloads by frame number.
+using Frames = std::map<std::uint64_t, std::string>;
+
+// Connects to `uri` and keeps retrying until the server is up.
+void Collect(ClientType* client, const std::string& uri, Frames* frames) {
+  websocketpp::lib::error_code error;
+  const auto connection = client->get_connection(uri, error);
+  CHECK(!error);
+
+  connection->set_message_handler([frames](const auto&, const auto& message) {
+    const std::string& payload = message->get_payload();
+    const auto json = nlohmann::json::parse(payload, nullptr, false);
+    if (json.is_object() && json.value("type", "") == "startFrame") {
+      frames->emplace(json.at("frame").get<std::uint64_t>(), payload);
+    }
+  });
+  connection->set_fail_handler([client, uri, frames](const auto&) {
+    client->set_timer(kReconnectDelay.count(), [client, uri, frames](const auto& error) {
+      if (!error) {
+        Collect(client, uri, frames);
+      }
+    });
+  });
+
+  client->connect(connection);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 2) {
+    std::fprintf(stderr, "Usage: %s <path to webcave-server>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  const std::string server = argv[1];
+
+  const pid_t upstream = StartServer(server, {"-p", std::to_string(kPort)});
+  const pid_t first_relay = StartServer(server, {"-p", std::to_string(kPort + 1),
+                                                 "-u", Uri(kPort)});
+  const pid_t second_relay = StartServer(server, {"-p", std::to_string(kPort + 2),
+                                                  "-u", Uri(kPort + 1)});
+
+  Frames upstream_frames;
+  Frames relayed_frames;
+  {
+    ClientType client;
+    client.clear_access_channels(websocketpp::log::alevel::all);
+    client.clear_error_channels(websocketpp::log::elevel::all);
+    client.init_asio();
+
+    Collect(&client, Uri(kPort), &upstream_frames);
+    Collect(&client, Uri(kPort + 2), &relayed_frames);
+    client.set_timer(kCollectDuration.count(), [&client](const auto&) { client.stop(); });
+    client.run();
+  }
+
+  StopServer(second_relay);
+  StopServer(first_relay);
+  StopServer(upstream);
+
+  std::size_t common_frames = 0;
+  for (const auto& [frame, payload] : relayed_frames) {
+    if (const auto upstream_frame = upstream_frames.find(frame);
+        upstream_frame != upstream_frames.end()) {
+      // Frame number, time and tracking data must pass through unchanged.
+      CHECK(payload == upstream_frame->second);
+      ++common_frames;
+    }
+  }
+  std::printf("\n%zu upstream frames, %zu relayed frames, %zu in common\n",
+              upstream_frames.size(), relayed_frames.size(), common_frames);
+  CHECK(common_frames >= kMinCommonFrames);
+
+  std::printf("relay_test passed\n");
+  return EXIT_SUCCESS;
+}
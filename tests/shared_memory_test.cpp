@@ -0,0 +1,139 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+
+#include "check.hpp"
+#include "shared_memory.hpp"
+#include "shared_memory_output.hpp"
+
+namespace {
+
+constexpr std::uint32_t kNumSlots = 4;
+constexpr std::uint64_t kNumFrames = 20;
+
+BinaryFrame MakeFrame(std::uint64_t frame) {
+  BinaryFrame binary_frame{};
+  binary_frame.header.frame = frame;
+  binary_frame.header.time = frame / 60.0;
+  binary_frame.header.num_bodies = 1;
+  binary_frame.bodies[0].id = static_cast<std::uint32_t>(frame);
+  binary_frame.bodies[0].is_tracked = 1;
+  return binary_frame;
+}
+
+void TestStreaming(const std::string& name) {
+  SharedMemoryOutput output(name, kNumSlots);
+  CHECK(output.IsValid());
+
+  SharedMemoryReader reader(name);
+  CHECK(reader.IsOpen());
+
+  BinaryFrame frame;
+  CHECK(!reader.ReadLatest(&frame));
+
+  std::thread writer([&output]() {
+    for (std::uint64_t i = 0; i < kNumFrames; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      output.Publish(MakeFrame(i));
+    }
+  });
+
+  std::uint64_t frames_seen = 0;
+  while (frames_seen < kNumFrames &&
+         reader.WaitForFrame(frames_seen, std::chrono::seconds(1))) {
+    std::uint64_t index;
+    CHECK(reader.ReadLatest(&frame, &index));
+    CHECK(frame.header.frame == index);
+    CHECK(frame.header.num_bodies == 1);
+    CHECK(frame.bodies[0].id == index);
+    frames_seen = index + 1;
+  }
+  writer.join();
+
+  CHECK(frames_seen == kNumFrames);
+  CHECK(reader.Read(kNumFrames - 1, &frame));
+  // Overwritten by the ring.
+  CHECK(!reader.Read(0, &frame));
+  // Not written yet.
+  CHECK(!reader.Read(kNumFrames, &frame));
+  CHECK(!reader.WaitForFrame(kNumFrames, std::chrono::milliseconds(10)));
+}
+
+void TestStuckSlot(const std::string& name) {
+  SharedMemoryOutput output(name, kNumSlots);
+  output.Publish(MakeFrame(0));
+
+  SharedMemoryReader reader(name);
+  CHECK(reader.IsOpen());
+
+  // Simulate a writer that died in the middle of publishing frame 1.
+  const int fd = shm_open(name.c_str(), O_RDWR, 0);
+  CHECK(fd >= 0);
+  void* memory = mmap(nullptr, SharedMemorySize(kNumSlots), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(memory != MAP_FAILED);
+  auto* header = static_cast<SharedMemoryHeader*>(memory);
+  SharedMemorySlots(header)[1].sequence.fetch_add(1);
+  header->frames_written.store(2);
+
+  BinaryFrame frame;
+  const auto start = std::chrono::steady_clock::now();
+  CHECK(!reader.Read(1, &frame));
+  CHECK(!reader.ReadLatest(&frame));
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+  CHECK(reader.Read(0, &frame));
+  CHECK(header->waiters.load() == 0);
+
+  munmap(memory, SharedMemorySize(kNumSlots));
+}
+
+void TestLiveWriter(const std::string& name) {
+  SharedMemoryOutput output(name, kNumSlots);
+  CHECK(output.IsValid());
+  output.Publish(MakeFrame(0));
+
+  // A second writer must not replace the segment while the first is alive.
+  SharedMemoryOutput second_output(name, kNumSlots);
+  CHECK(!second_output.IsValid());
+
+  SharedMemoryReader reader(name);
+  CHECK(reader.IsOpen());
+  CHECK(reader.FramesWritten() == 1);
+}
+
+void TestStaleWriter(const std::string& name) {
+  // Leave a segment behind whose writer has exited without cleaning up.
+  const pid_t child = fork();
+  CHECK(child >= 0);
+  if (child == 0) {
+    SharedMemoryOutput output(name, kNumSlots);
+    output.Publish(MakeFrame(0));
+    _exit(output.IsValid() ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+  int status;
+  CHECK(waitpid(child, &status, 0) == child);
+  CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+
+  SharedMemoryOutput output(name, kNumSlots);
+  CHECK(output.IsValid());
+  SharedMemoryReader reader(name);
+  CHECK(reader.IsOpen());
+  CHECK(reader.FramesWritten() == 0);
+}
+
+}
+
+int main() {
+  const std::string name = "/webcave-test-" + std::to_string(getpid());
+  TestStreaming(name);
+  TestStuckSlot(name);
+  TestLiveWriter(name);
+  TestStaleWriter(name);
+  std::printf("shared_memory_test passed\n");
+  return EXIT_SUCCESS;
+}
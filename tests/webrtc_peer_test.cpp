@@ -0,0 +1,104 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <variant>
+
+#include "check.hpp"
+#include "rtc/rtc.hpp"
+#include "webrtc_peer.hpp"
+
+// Connects a WebRtcPeer to a plain libdatachannel peer over loopback, the
+// remote side plays the role of the browser.
+int main() {
+  using namespace std::chrono_literals;
+
+  auto remote = std::make_shared<rtc::PeerConnection>(rtc::Configuration());
+
+  // The peer may emit its offer before the constructor has returned, so the
+  // remote side waits for it before answering.
+  std::promise<WebRtcPeer*> peer_promise;
+  std::shared_future<WebRtcPeer*> peer_future = peer_promise.get_future().share();
+
+  remote->onLocalDescription([peer_future](rtc::Description description) {
+    peer_future.get()->HandleSignaling({
+      { "type", "rtcDescription" },
+      { "description", {
+        { "type", description.typeString() },
+        { "sdp", std::string(description) },
+      }},
+    });
+  });
+  remote->onLocalCandidate([peer_future](rtc::Candidate candidate) {
+    peer_future.get()->HandleSignaling({
+      { "type", "rtcCandidate" },
+      { "candidate", {
+        { "candidate", std::string(candidate) },
+        { "sdpMid", candidate.mid() },
+      }},
+    });
+  });
+
+  std::shared_ptr<rtc::DataChannel> remote_channel;
+  std::promise<rtc::Reliability> reliability_promise;
+  std::promise<std::string> message_promise;
+  std::atomic<bool> has_message = false;
+  remote->onDataChannel([&](std::shared_ptr<rtc::DataChannel> channel) {
+    remote_channel = channel;
+    reliability_promise.set_value(channel->reliability());
+    channel->onMessage([&](rtc::message_variant message) {
+      if (std::holds_alternative<std::string>(message) && !has_message.exchange(true)) {
+        message_promise.set_value(std::get<std::string>(message));
+      }
+    });
+  });
+
+  auto peer = std::make_unique<WebRtcPeer>("", [remote](const nlohmann::json& message) {
+    if (message.at("type") == "rtcDescription") {
+      const auto& description = message.at("description");
+      remote->setRemoteDescription(rtc::Description(
+          description.at("sdp").get<std::string>(),
+          description.at("type").get<std::string>()));
+    } else if (message.at("type") == "rtcCandidate") {
+      const auto& candidate = message.at("candidate");
+      remote->addRemoteCandidate(rtc::Candidate(
+          candidate.at("candidate").get<std::string>(),
+          candidate.at("sdpMid").get<std::string>()));
+    }
+  });
+  peer_promise.set_value(peer.get());
+  CHECK(peer->IsActive());
+
+  auto reliability_future = reliability_promise.get_future();
+  CHECK(reliability_future.wait_for(10s) == std::future_status::ready);
+  const rtc::Reliability reliability = reliability_future.get();
+  CHECK(reliability.unordered);
+  CHECK(reliability.maxRetransmits.has_value() && *reliability.maxRetransmits == 0);
+
+  const auto deadline = std::chrono::steady_clock::now() + 10s;
+  while (!peer->IsOpen() && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(10ms);
+  }
+  CHECK(peer->IsOpen());
+  CHECK(peer->IsActive());
+
+  // The channel is unreliable, so keep sending until a message got through.
+  auto message_future = message_promise.get_future();
+  while (message_future.wait_for(10ms) != std::future_status::ready &&
+         std::chrono::steady_clock::now() < deadline) {
+    CHECK(peer->Send("{\"type\":\"startFrame\"}"));
+  }
+  CHECK(message_future.wait_for(0s) == std::future_status::ready);
+  CHECK(message_future.get() == "{\"type\":\"startFrame\"}");
+
+  peer.reset();
+  remote_channel.reset();
+  remote->close();
+
+  std::printf("webrtc_peer_test passed\n");
+  return EXIT_SUCCESS;
+}